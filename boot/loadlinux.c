@@ -72,12 +72,23 @@ void load_linux(void)
     bzero(&boot_params, 0x1f1);     /* clear everything up to the setup_header */
     bp = &boot_params;
 
-    // Copy kernel
+    // Set up e820 map.  This has to happen before the kernel is copied,
+    // since the e820 segment may lie in the area that the kernel is copied to.
+    if (debug_mode) printf(" Setting up fake e820 memory map...\n");
+    if (e820_size > 128*sizeof(struct e820entry)) {
+        printf(" Error: e820_size 0x%08x too large\n", e820_size);
+        abort();
+    }
+    memcpy(&bp->e820_map[0], e820_start, e820_size);
+    bp->e820_entries = e820_size / sizeof(struct e820entry);
+
+    // Copy kernel.  The bzImage segment may overlap the destination (it
+    // can be loaded anywhere above 1 MiB), so use memmove().
     unsigned int kernel32_size = 16 * bp->syssize;
     const char *kernel32_start = bzImage_start + (bp->setup_sects+1)*512;
     if (debug_mode)
         printf(" Copying 32-bit kernel code to 0x%08x...\n", (uint32_t) kernel32_start);
-    memcpy(kernel32_entry_point, kernel32_start, kernel32_size);
+    memmove(kernel32_entry_point, kernel32_start, kernel32_size);
 
     // Dump the first few bytes of Linux code
     if (0) {
@@ -97,13 +108,4 @@ void load_linux(void)
     bp->cmd_line_ptr = (uint32_t) kernel_command_line;
     bp->ramdisk_image = (uint32_t) initrd_start;
     bp->ramdisk_size = initrd_size;
-
-    // Set up e820 map
-    if (debug_mode) printf(" Setting up fake e820 memory map...\n");
-    if (e820_size > 128*sizeof(struct e820entry)) {
-        printf(" Error: e820_size 0x%08x too large\n", e820_size);
-        abort();
-    }
-    memcpy(&bp->e820_map[0], e820_start, e820_size);
-    bp->e820_entries = e820_size / sizeof(struct e820entry);
 }
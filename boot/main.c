@@ -1,6 +1,7 @@
 #include "main.h"
 #include "portio.h"
 #include "pirq.h"
+#include "pci.h"
 #include "memory.h"
 #include "serial.h"
 #include "segment.h"
@@ -22,6 +23,12 @@ bool debug_mode = false;
 
 #define DEBUG_FLAG (1u<<8)
 
+// The cmdline segment may get overwritten when the kernel is copied to 1 MiB,
+// so we keep a copy inside the loader's own (reserved) memory.
+// mknbi-linux-netxfer refuses to build images with longer command lines.
+#define COMMAND_LINE_SIZE 2048
+static char command_line_buf[COMMAND_LINE_SIZE];
+
 // Set up a flat memory model for Linux, per the requireents in the "32-bit
 // BOOT PROTOCOL" specified in linux-2.6/Documentation/x86/boot.txt.
 // Linux needs a 4-entry global descriptor table, as follows:
@@ -115,6 +122,7 @@ struct nbi_header {
 void c_main(struct nbi_header *nbi_header)
 {
     struct gdtr gdtr;
+    uint32_t len;
 
     // The built-in NETXFER program on the Evo T30 provides several services
     // to the netboot image via a service routine.  This sets up the function
@@ -138,7 +146,11 @@ void c_main(struct nbi_header *nbi_header)
             debug_mode = (nbi_header->entries[0].ftl & DEBUG_FLAG) ? true : false;
             break;
         case 1: // cmdline
-            kernel_command_line = (char *)nbi_header->entries[i].load_address;
+            len = nbi_header->entries[i].memory_length;
+            if (len > COMMAND_LINE_SIZE-1) len = COMMAND_LINE_SIZE-1;
+            memcpy(command_line_buf, (char *)nbi_header->entries[i].load_address, len);
+            command_line_buf[len] = '\0';
+            kernel_command_line = command_line_buf;
             printf("Linux cmdline: %s\n", kernel_command_line);
             break;
         case 2: // bzImage
@@ -205,6 +217,10 @@ void c_main(struct nbi_header *nbi_header)
     if (debug_mode) printf("Creating PCI IRQ table...\n");
     create_pirq_table();
 
+    // Set up the PCI bus for speed (normally done by a BIOS)
+    if (debug_mode) printf("Tuning PCI devices...\n");
+    pci_tune();
+
     // Copy Linux to its proper location in memory
     printf("Loading Linux...\n");
     load_linux();
@@ -20,3 +20,20 @@ void *memcpy(void *dest, const void *src, unsigned int n)
     return dest;
 }
 
+void *memmove(void *dest, const void *src, unsigned int n)
+{
+    char *d = dest;
+    const char *s = src;
+    if (d <= s) {
+        while (n-- > 0) {
+            *d++ = *s++;
+        }
+    } else {
+        d += n;
+        s += n;
+        while (n-- > 0) {
+            *--d = *--s;
+        }
+    }
+    return dest;
+}
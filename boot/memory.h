@@ -2,4 +2,5 @@
 #define MEMORY_H
 extern void bzero(void *s, unsigned int n);
 extern void *memcpy(void *dest, const void *src, unsigned int n);
+extern void *memmove(void *dest, const void *src, unsigned int n);
 #endif /* MEMORY_H */
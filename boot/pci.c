@@ -0,0 +1,382 @@
+#include "pci.h"
+#include "main.h"
+#include "portio.h"
+#include "printf.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+uint8_t pci_config_in8(unsigned int busno, unsigned int devfunc,
+    unsigned int index)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    return inb(0xcfc | (index & 3));
+}
+
+uint16_t pci_config_in16(unsigned int busno, unsigned int devfunc,
+    unsigned int index)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    return inw(0xcfc | (index & 2));
+}
+
+uint32_t pci_config_in32(unsigned int busno, unsigned int devfunc,
+    unsigned int index)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    return inl(0xcfc);
+}
+
+void pci_config_out8(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint8_t value)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    outb(value, 0xcfc | (index & 3));
+}
+
+void pci_config_out16(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint16_t value)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    outw(value, 0xcfc | (index & 2));
+}
+
+void pci_config_out32(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint32_t value)
+{
+    outl(0x80000000
+            | ((busno & 0xff) << 16)
+            | ((devfunc & 0xff) << 8)
+            | (index & 0xfc), 0xcf8);
+    outl(value, 0xcfc);
+}
+
+// Configuration registers common to all PCI devices
+#define PCI_VENDOR_ID 0x00
+#define PCI_DEVICE_ID 0x02
+#define PCI_COMMAND 0x04
+#define PCI_COMMAND_IO 0x0001
+#define PCI_COMMAND_INVALIDATE 0x0010   // Memory Write and Invalidate
+#define PCI_CLASS_REVISION 0x08
+#define PCI_CACHE_LINE_SIZE 0x0c
+#define PCI_LATENCY_TIMER 0x0d
+#define PCI_HEADER_TYPE 0x0e
+#define PCI_BASE_ADDRESS_4 0x20
+#define PCI_CB_LATENCY_TIMER 0x1b       // CardBus bridges only
+
+#define PCI_ANY 0xffff
+
+// One register setting: the bits of "mask" in the register are set to
+// those of "value", on every device that matches "vendor" and "device".
+struct pci_setting {
+    uint16_t vendor;
+    uint16_t device;
+    uint8_t index;
+    uint8_t width;      // 8, 16 or 32 bits
+    uint32_t mask;
+    uint32_t value;
+    const char *name;
+};
+
+// NETXFER leaves these at their conservative power-on values: without a
+// cache line size there's no Memory Write and Invalidate, a short latency
+// timer makes a bus master give up the bus as soon as another one asks for
+// it, and the GX1 doesn't burst as far as it could.  A BIOS would have set
+// these up; Linux only does some of it, and only when the driver for that
+// device asks.  The settings are applied in order, so the cache line size
+// comes before MWI.
+static const struct pci_setting pci_profile[] = {
+    // All devices
+    { PCI_ANY, PCI_ANY, PCI_CACHE_LINE_SIZE, 8, 0xff, 16/4, "cache line size" },  // GX1: 16-byte lines, in dwords
+    { PCI_ANY, PCI_ANY, PCI_LATENCY_TIMER, 8, 0xff, 0x40, "latency timer" },     // 64 clocks, as Linux uses
+    { PCI_ANY, PCI_ANY, PCI_COMMAND, 16, PCI_COMMAND_INVALIDATE, PCI_COMMAND_INVALIDATE, "command" },
+
+    // GX1 host bridge ("PCI master").  These are the values Linux's cs5530
+    // IDE drivers use: MWI on the internal X-bus, write posting, 16-byte
+    // bursts (which seem to work best), and the arbiter settings that the
+    // CS5530 needs for IDE DMA.
+    { 0x1078, 0x0001, 0x40, 8, 0xff, 0x1e, "PCI control 1" },
+    { 0x1078, 0x0001, 0x41, 8, 0xff, 0x14, "PCI control 2" },
+    { 0x1078, 0x0001, 0x42, 8, 0xff, 0x00, "PCI control 3" },
+    { 0x1078, 0x0001, 0x43, 8, 0xff, 0xc1, "PCI arbitration" },
+
+    // CS5530A function 0 (bridge configuration): don't trap accesses to
+    // the UDMA registers.  There's no VSA to handle the SMI.
+    { 0x1078, 0x0100, 0xd0, 16, 0xffff, 0x5006, "UDMA trap control" },
+
+    // TI PCI1410 CardBus bridge: the same latency timer on the CardBus side
+    { 0x104c, 0xac50, PCI_CB_LATENCY_TIMER, 8, 0xff, 0x40, "CardBus latency timer" },
+};
+
+static uint32_t pci_config_read(unsigned int busno, unsigned int devfunc,
+    unsigned int index, unsigned int width)
+{
+    switch (width) {
+    case 8:
+        return pci_config_in8(busno, devfunc, index);
+    case 16:
+        return pci_config_in16(busno, devfunc, index);
+    default:
+        return pci_config_in32(busno, devfunc, index);
+    }
+}
+
+static void pci_config_write(unsigned int busno, unsigned int devfunc,
+    unsigned int index, unsigned int width, uint32_t value)
+{
+    switch (width) {
+    case 8:
+        pci_config_out8(busno, devfunc, index, value);
+        break;
+    case 16:
+        pci_config_out16(busno, devfunc, index, value);
+        break;
+    default:
+        pci_config_out32(busno, devfunc, index, value);
+    }
+}
+
+static void pci_apply_profile(unsigned int busno, unsigned int devfunc,
+    uint16_t vendor, uint16_t device)
+{
+    for (size_t i = 0; i < sizeof(pci_profile)/sizeof(pci_profile[0]); i++) {
+        const struct pci_setting *s = &pci_profile[i];
+        if (s->vendor != PCI_ANY && s->vendor != vendor) continue;
+        if (s->device != PCI_ANY && s->device != device) continue;
+
+        // MWI is only allowed with a cache line size the device accepted.
+        // (A register the device doesn't implement reads back as 0.)
+        if (s->index == PCI_COMMAND && (s->value & PCI_COMMAND_INVALIDATE)
+                && pci_config_in8(busno, devfunc, PCI_CACHE_LINE_SIZE) == 0) {
+            continue;
+        }
+
+        uint32_t old = pci_config_read(busno, devfunc, s->index, s->width);
+        uint32_t new = (old & ~s->mask) | (s->value & s->mask);
+        if (new != old) {
+            pci_config_write(busno, devfunc, s->index, s->width, new);
+        }
+        if (debug_mode) {
+            printf("PCI %02x:%02x.%d %s (%02Xh): 0x%x -> 0x%x\n",
+                busno, devfunc >> 3, devfunc & 7, s->name, s->index,
+                old, pci_config_read(busno, devfunc, s->index, s->width));
+        }
+    }
+}
+
+// ATA task file registers, relative to 1F0h/170h
+#define ATA_DATA 0
+#define ATA_NSECT 2
+#define ATA_LBAL 3
+#define ATA_DEVICE 6
+#define ATA_STATUS 7    // read
+#define ATA_COMMAND 7   // write
+
+#define ATA_BUSY 0x80
+#define ATA_DRQ 0x08
+#define ATA_ERR 0x01
+#define ATA_NIEN 0x02   // device control register: no interrupts
+#define ATA_CMD_IDENTIFY 0xec
+
+// Each status read takes about 1us, so this gives a drive about a second.
+// If it's still spinning up after that, Linux can set it up.  Before we
+// know that there's a drive at all, give it less, since an empty channel's
+// status reads as 0xff (busy) for as long as we care to wait.
+#define ATA_TIMEOUT 1000000
+#define ATA_SELECT_TIMEOUT 100000
+
+static bool ata_wait(uint16_t port, uint8_t mask, uint8_t value, long timeout)
+{
+    for (long i = 0; i < timeout; i++) {
+        if ((inb(port + ATA_STATUS) & mask) == value) return true;
+    }
+    return false;
+}
+
+// Read a drive's IDENTIFY DEVICE data.  Returns false if there's no drive,
+// or if it's an ATAPI device (which aborts the command).
+static bool ata_identify(uint16_t port, uint16_t ctl, unsigned int drive,
+    uint16_t *id)
+{
+    outb(ATA_NIEN, ctl);
+    outb(0xa0 | (drive << 4), port + ATA_DEVICE);
+    for (int i = 0; i < 4; i++) inb(ctl);   // 400ns
+
+    // A drive ignores register writes while it's busy (e.g. spinning up).
+    if (!ata_wait(port, ATA_BUSY, 0, ATA_SELECT_TIMEOUT)) return false;
+
+    // If nobody holds what we write to the registers, there's no drive.
+    outb(0x55, port + ATA_NSECT);
+    outb(0xaa, port + ATA_LBAL);
+    if (inb(port + ATA_NSECT) != 0x55 || inb(port + ATA_LBAL) != 0xaa) {
+        return false;
+    }
+
+    if (!ata_wait(port, ATA_BUSY, 0, ATA_TIMEOUT)) return false;
+    outb(ATA_CMD_IDENTIFY, port + ATA_COMMAND);
+    for (int i = 0; i < 4; i++) inb(ctl);
+    if (!ata_wait(port, ATA_BUSY, 0, ATA_TIMEOUT)) return false;
+    if ((inb(port + ATA_STATUS) & (ATA_DRQ | ATA_ERR)) != ATA_DRQ) return false;
+    for (int i = 0; i < 256; i++) {
+        id[i] = inw(port + ATA_DATA);
+    }
+    return true;
+}
+
+// CS5530 IDE timings, from Linux's pata_cs5530.  Bit 31 of drive 0's DMA
+// timing register selects one of two formats for the PIO timings.
+static const uint32_t cs5530_pio_timings[2][5] = {
+    { 0x00009172, 0x00012171, 0x00020080, 0x00032010, 0x00040010 },
+    { 0xd1329172, 0x71212171, 0x30200080, 0x20102010, 0x00100010 }
+};
+static const uint32_t cs5530_mwdma_timings[3] = {
+    0x00077771, 0x00012121, 0x00002020
+};
+static const uint32_t cs5530_udma_timings[3] = {
+    0x00921250, 0x00911140, 0x00911030
+};
+
+#define CS5530_UDMA 0x00100000  // in drive 0's DMA timing: UDMA for both drives
+
+// CS5530A function 0: which of the legacy IDE channels it decodes
+#define CS5530_DECODE_CONTROL_2 0x53
+#define CS5530_PRIMARY_IDE 0x04
+#define CS5530_SECONDARY_IDE 0x08
+
+static unsigned int ata_pio_mode(const uint16_t *id)
+{
+    if (id[53] & 2) {   // words 64-70 are valid
+        if (id[64] & 2) return 4;
+        if (id[64] & 1) return 3;
+    }
+    return (id[51] >> 8) <= 2 ? (id[51] >> 8) : 0;
+}
+
+// Returns the CS5530 timing for the fastest DMA mode the drive supports
+// (up to UDMA/33), or 0 if it doesn't do DMA.
+static uint32_t cs5530_dma_timing(const uint16_t *id)
+{
+    if (!(id[49] & 0x100)) return 0;
+    if (id[53] & 4) {   // word 88 is valid
+        for (int mode = 2; mode >= 0; mode--) {
+            if (id[88] & (1 << mode)) return cs5530_udma_timings[mode];
+        }
+    }
+    for (int mode = 2; mode >= 0; mode--) {
+        if (id[63] & (1 << mode)) return cs5530_mwdma_timings[mode];
+    }
+    return 0;
+}
+
+// Set the PIO and DMA timings for each drive on the CS5530's IDE channels.
+// The drive's own DMA mode is left for Linux to set (with SET FEATURES);
+// we only mark the drive as DMA-capable in the bus master status register.
+static void cs5530_ide_tune(unsigned int busno, unsigned int devfunc)
+{
+    uint32_t bar = pci_config_in32(busno, devfunc, PCI_BASE_ADDRESS_4);
+    if (!(bar & 1) || !(pci_config_in16(busno, devfunc, PCI_COMMAND) & PCI_COMMAND_IO)) {
+        if (debug_mode) printf("CS5530 IDE: bus master I/O space not enabled\n");
+        return;
+    }
+    // An unassigned BAR reads back as just the I/O bit, and the timing
+    // registers would then be the PIC's ports.
+    uint16_t bmide = bar & 0xfffc;
+    if (bmide == 0) {
+        if (debug_mode) printf("CS5530 IDE: bus master I/O space not assigned\n");
+        return;
+    }
+
+    uint8_t decode = pci_config_in8(busno, devfunc & ~7, CS5530_DECODE_CONTROL_2);
+    if (!(decode & (CS5530_PRIMARY_IDE | CS5530_SECONDARY_IDE))) {
+        if (debug_mode) printf("CS5530 IDE: channels not enabled\n");
+        return;
+    }
+
+    for (unsigned int channel = 0; channel < 2; channel++) {
+        if (!(decode & (channel ? CS5530_SECONDARY_IDE : CS5530_PRIMARY_IDE))) continue;
+        uint16_t port = channel ? 0x170 : 0x1f0;
+        uint16_t ctl = channel ? 0x376 : 0x3f6;
+        uint16_t timings = bmide + 0x20 + 0x10*channel;
+        uint16_t bmstatus = bmide + 0x02 + 0x08*channel;
+
+        for (unsigned int drive = 0; drive < 2; drive++) {
+            uint16_t id[256];
+            if (!ata_identify(port, ctl, drive, id)) continue;
+
+            uint16_t pio_reg = timings + 0x08*drive;
+            uint16_t dma_reg = timings + 0x04 + 0x08*drive;
+            uint32_t old_pio = inl(pio_reg);
+            uint32_t old_dma = inl(dma_reg);
+
+            unsigned int pio = ata_pio_mode(id);
+            unsigned int format = (inl(timings + 0x04) & 0x80000000) ? 1 : 0;
+            outl(cs5530_pio_timings[format][pio], pio_reg);
+
+            uint32_t dma = cs5530_dma_timing(id);
+            if (dma) {
+                uint32_t tuning = inl(timings + 0x04);
+                if (drive == 0) {
+                    outl(dma | (tuning & 0x80000000), dma_reg);
+                } else {
+                    tuning = (tuning & ~CS5530_UDMA) | (dma & CS5530_UDMA);
+                    outl(tuning, timings + 0x04);
+                    outl(dma, dma_reg);
+                }
+                outb(inb(bmstatus) | (0x20 << drive), bmstatus);
+            }
+
+            if (debug_mode) {
+                printf("CS5530 IDE %d.%d: PIO %d%s: timings 0x%08x/0x%08x -> 0x%08x/0x%08x\n",
+                    channel, drive, pio,
+                    dma ? ((dma & CS5530_UDMA) ? ", UDMA" : ", MWDMA") : "",
+                    old_pio, old_dma, inl(pio_reg), inl(dma_reg));
+            }
+        }
+    }
+}
+
+// Find the devices on bus 0 and apply pci_profile to each of them.
+// (Nothing is behind the CardBus bridge until Linux sets it up.)
+void pci_tune(void)
+{
+    const unsigned int busno = 0;
+
+    for (unsigned int dev = 0; dev < 32; dev++) {
+        for (unsigned int func = 0; func < 8; func++) {
+            unsigned int devfunc = (dev << 3) | func;
+            uint16_t vendor = pci_config_in16(busno, devfunc, PCI_VENDOR_ID);
+            if (vendor == 0xffff) {
+                if (func == 0) break;
+                continue;
+            }
+            uint16_t device = pci_config_in16(busno, devfunc, PCI_DEVICE_ID);
+            if (debug_mode) {
+                printf("PCI %02x:%02x.%d: %04x:%04x class %06x\n",
+                    busno, dev, func, vendor, device,
+                    pci_config_in32(busno, devfunc, PCI_CLASS_REVISION) >> 8);
+            }
+
+            pci_apply_profile(busno, devfunc, vendor, device);
+            if (vendor == 0x1078 && device == 0x0102) {     // CS5530A IDE
+                cs5530_ide_tune(busno, devfunc);
+            }
+
+            // Only multi-function devices have functions 1-7
+            if (func == 0 && !(pci_config_in8(busno, devfunc, PCI_HEADER_TYPE) & 0x80)) break;
+        }
+    }
+}
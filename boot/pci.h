@@ -0,0 +1,21 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+extern uint8_t pci_config_in8(unsigned int busno, unsigned int devfunc,
+    unsigned int index);
+extern uint16_t pci_config_in16(unsigned int busno, unsigned int devfunc,
+    unsigned int index);
+extern uint32_t pci_config_in32(unsigned int busno, unsigned int devfunc,
+    unsigned int index);
+extern void pci_config_out8(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint8_t value);
+extern void pci_config_out16(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint16_t value);
+extern void pci_config_out32(unsigned int busno, unsigned int devfunc,
+    unsigned int index, uint32_t value);
+
+extern void pci_tune(void);
+
+#endif /* PCI_H */
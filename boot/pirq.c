@@ -1,4 +1,5 @@
 #include "pirq.h"
+#include "pci.h"
 #include "memory.h"
 #include "portio.h"
 #include "printf.h"
@@ -6,66 +7,6 @@
 
 #define CFGINT 0x3c
 
-static uint8_t pci_config_in8(unsigned int busno, unsigned int devfunc,
-    unsigned int index)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    return inb(0xcfc | (index & 3));
-}
-
-static uint16_t pci_config_in16(unsigned int busno, unsigned int devfunc,
-    unsigned int index)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    return inw(0xcfc | (index & 2));
-}
-
-static uint32_t pci_config_in32(unsigned int busno, unsigned int devfunc,
-    unsigned int index)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    return inl(0xcfc);
-}
-
-static void pci_config_out8(unsigned int busno, unsigned int devfunc,
-    unsigned int index, uint8_t value)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    outb(value, 0xcfc | (index & 3));
-}
-
-static void pci_config_out16(unsigned int busno, unsigned int devfunc,
-    unsigned int index, uint16_t value)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    outw(value, 0xcfc | (index & 2));
-}
-
-static void pci_config_out32(unsigned int busno, unsigned int devfunc,
-    unsigned int index, uint32_t value)
-{
-    outl(0x80000000
-            | ((busno & 0xff) << 16)
-            | ((devfunc & 0xff) << 8)
-            | (index & 0xfc), 0xcf8);
-    outl(value, 0xcfc);
-}
-
 #define PCI_F0_IN8(index) pci_config_in8(0, 0x12 << 3, index)
 #define PCI_F0_IN16(index) pci_config_in16(0, 0x12 << 3, index)
 #define PCI_F0_IN32(index) pci_config_in32(0, 0x12 << 3, index)
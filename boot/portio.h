@@ -15,7 +15,7 @@ static inline void outb(uint8_t value, uint16_t port)
 static inline void outw(uint16_t value, uint16_t port)
 {
     __asm__ volatile (
-        "outl %0, %1\n"
+        "outw %0, %1\n"
         : /* no output */
         : "a"(value), "d"(port)
         );